@@ -21,6 +21,9 @@ long *arr = NULL;
 
 int lock = 0;
 
+FILE *trace_file = NULL;
+unsigned long trace_prev_va = 0;
+
 /*
 Function responsible for allocating and setting physical memory 
 */
@@ -74,6 +77,10 @@ void set_physical_mem() {
     // malloc array to track sizes
     arr = malloc(sizeof(long) * (MEMSIZE / PGSIZE));
 
+    // start recording an address trace if VM_TRACE names a file
+    char *trace_path = getenv("VM_TRACE");
+    if(trace_path != NULL && trace_file == NULL) start_trace(trace_path);
+
     // cleanup function on exit
     atexit(cleanup);
 
@@ -144,6 +151,59 @@ print_TLB_missrate()
 }
 
 
+/*
+ * Writes value to the trace file 7 bits at a time, low bits first.
+ * The high bit of each byte is set when more bytes follow.
+ */
+void trace_put_varint(unsigned long value) {
+    while(value >= 0x80) {
+        fputc((int) (value & 0x7f) | 0x80, trace_file);
+        value >>= 7;
+    }
+    fputc((int) value, trace_file);
+}
+
+
+/*
+ * Records va as the signed distance from the previously recorded address.
+ * Zigzag encoding keeps small negative deltas small.
+ */
+void trace_record(void *va) {
+    long delta = (long) ((unsigned long) va - trace_prev_va);
+    unsigned long zigzag = ((unsigned long) delta << 1) ^ (unsigned long) (delta >> (sizeof(long) * 8 - 1));
+    trace_put_varint(zigzag);
+    trace_prev_va = (unsigned long) va;
+}
+
+
+/*
+ * Starts recording every virtual address passed to translate() into path.
+ * The trace can be replayed against other TLB geometries with tlb_replay.
+ * Returns 0 on success and -1 if the file cannot be opened.
+ */
+int start_trace(const char *path) {
+    stop_trace();
+    trace_file = fopen(path, "wb");
+    if(trace_file == NULL) return -1;
+
+    fwrite(TRACE_MAGIC, 1, 4, trace_file);
+    trace_put_varint(TRACE_VERSION);
+    trace_put_varint(PGSIZE);
+    trace_prev_va = 0;
+    return 0;
+}
+
+
+/*
+ * Flushes and closes the trace file, if one is open.
+ */
+void stop_trace() {
+    if(trace_file == NULL) return;
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+
 /*
 The function takes a virtual address and page directories starting address and
 performs translation to return the physical address
@@ -157,6 +217,9 @@ pte_t *translate(pde_t *pgdir, void *va) {
     * translation exists, then you can return physical address from the TLB.
     */
 
+    // record the address before the TLB check so replay sees every lookup
+    if(trace_file != NULL) trace_record(va);
+
     // Part 2 TLB Check
     lookups = lookups + 1;
 	pte_t *pa = check_TLB(va);
@@ -563,6 +626,7 @@ void clear_bit_at_index(char *bitmap, int index)
 
 
 void cleanup() {
+    stop_trace();
     free(physical_memory);
     free(physical_bitmap);
     free(virtual_bitmap);
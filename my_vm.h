@@ -42,6 +42,11 @@ struct tlb {
 };
 struct tlb tlb_store;
 
+// Address trace file format: TRACE_MAGIC, then varint TRACE_VERSION and
+// varint PGSIZE, then one zigzag varint delta per translated virtual address
+#define TRACE_MAGIC "VMTR"
+#define TRACE_VERSION 1
+
 
 void set_physical_mem();
 pte_t* translate(pde_t *pgdir, void *va);
@@ -54,6 +59,8 @@ void put_value(void *va, void *val, int size);
 void get_value(void *va, void *val, int size);
 void mat_mult(void *mat1, void *mat2, int size, void *answer);
 void print_TLB_missrate();
+int start_trace(const char *path);
+void stop_trace();
 
 // Our helper functions
 unsigned long search_bitmap_for_pages(char *bitmap, int num_pages, int bitmap_length);
@@ -0,0 +1,218 @@
+#include "my_vm.h"
+
+/*
+ * Replays an address trace recorded with start_trace() (or VM_TRACE) against
+ * many TLB geometries in a single pass and prints miss rate against TLB size.
+ *
+ * Each configuration is a page size and a number of sets. Every set keeps an
+ * LRU stack, so the stack distance of an access gives its hit/miss outcome for
+ * every associativity at once: an access hits in a W-way TLB exactly when its
+ * distance is less than W.
+ *
+ * Usage: tlb_replay <trace> [-p page_size]... [-s num_sets]... [-e max_entries]
+ */
+
+#define MAX_PAGE_SIZES 8
+#define MAX_SET_COUNTS 8
+
+struct replay_config {
+    unsigned long page_size;
+    int page_bits;
+    unsigned long num_sets;
+    unsigned long max_ways;
+    unsigned long *lru;     // max_ways page numbers per set, most recent first
+    unsigned long *fill;    // valid entries in each set's stack
+    unsigned long *hits;    // hits[d] = accesses found at stack distance d
+};
+
+
+/*
+ * Reads one varint written by trace_put_varint().
+ * Returns 0 on success and -1 at end of file.
+ */
+int read_varint(FILE *trace, unsigned long *value) {
+    unsigned long result = 0;
+    int shift = 0;
+    int byte;
+
+    do {
+        byte = getc(trace);
+        if(byte == EOF) return -1;
+        result |= (unsigned long) (byte & 0x7f) << shift;
+        shift += 7;
+    } while(byte & 0x80);
+
+    *value = result;
+    return 0;
+}
+
+
+/*
+ * Looks up vpn in its set's LRU stack, records the stack distance and
+ * moves vpn to the top of the stack.
+ */
+void replay_access(struct replay_config *config, unsigned long vpn) {
+    unsigned long set = vpn % config->num_sets;
+    unsigned long *stack = config->lru + (set * config->max_ways);
+    unsigned long fill = config->fill[set];
+    unsigned long distance;
+
+    for(distance = 0; distance < fill; distance++) {
+        if(stack[distance] == vpn) break;
+    }
+
+    if(distance < fill) config->hits[distance]++;
+    else {//miss for every associativity, evict the bottom if the stack is full
+        if(fill < config->max_ways) config->fill[set]++;
+        else distance = fill - 1;
+    }
+
+    memmove(stack + 1, stack, distance * sizeof(unsigned long));
+    stack[0] = vpn;
+}
+
+
+/*
+ * Prints miss rate for every power of two associativity up to max_ways.
+ */
+void print_config(struct replay_config *config, unsigned long accesses) {
+    if(config->num_sets == 1) {
+        printf("page size %lu, fully associative\n", config->page_size);
+    }
+    else {
+        printf("page size %lu, %lu sets\n", config->page_size, config->num_sets);
+    }
+    printf("%10s %8s %12s\n", "entries", "ways", "miss rate");
+
+    unsigned long hits = 0;
+    unsigned long distance = 0;
+    for(unsigned long ways = 1; ways <= config->max_ways; ways *= 2) {
+        while(distance < ways) hits += config->hits[distance++];
+        double miss_rate = accesses ? (double) (accesses - hits) / accesses : 0;
+        printf("%10lu %8lu %12lf\n", config->num_sets * ways, ways, miss_rate);
+    }
+    printf("\n");
+}
+
+
+int main(int argc, char **argv) {
+    unsigned long page_sizes[MAX_PAGE_SIZES];
+    unsigned long set_counts[MAX_SET_COUNTS];
+    int num_page_sizes = 0;
+    int num_set_counts = 0;
+    unsigned long max_entries = 4 * TLB_ENTRIES;
+    char *trace_path = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            if(num_page_sizes == MAX_PAGE_SIZES) {
+                fprintf(stderr, "at most %d page sizes\n", MAX_PAGE_SIZES);
+                return 1;
+            }
+            page_sizes[num_page_sizes++] = strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            if(num_set_counts == MAX_SET_COUNTS) {
+                fprintf(stderr, "at most %d set counts\n", MAX_SET_COUNTS);
+                return 1;
+            }
+            set_counts[num_set_counts++] = strtoul(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            max_entries = strtoul(argv[++i], NULL, 0);
+        }
+        else if(trace_path == NULL && argv[i][0] != '-') trace_path = argv[i];
+        else {//unknown option, print usage
+            trace_path = NULL;
+            break;
+        }
+    }
+    if(trace_path == NULL) {
+        fprintf(stderr, "usage: tlb_replay <trace> [-p page_size]... [-s num_sets]... [-e max_entries]\n");
+        return 1;
+    }
+
+    FILE *trace = fopen(trace_path, "rb");
+    if(trace == NULL) {
+        fprintf(stderr, "cannot open %s\n", trace_path);
+        return 1;
+    }
+
+    // check header
+    char magic[4];
+    unsigned long version, recorded_page_size;
+    if(fread(magic, 1, 4, trace) != 4 || memcmp(magic, TRACE_MAGIC, 4) != 0
+        || read_varint(trace, &version) || version != TRACE_VERSION
+        || read_varint(trace, &recorded_page_size)) {
+        fprintf(stderr, "%s is not a version %d trace\n", trace_path, TRACE_VERSION);
+        fclose(trace);
+        return 1;
+    }
+
+    // default to the recorded page size and a few larger ones
+    if(num_page_sizes == 0) {
+        page_sizes[num_page_sizes++] = recorded_page_size;
+        page_sizes[num_page_sizes++] = recorded_page_size * 2;
+        page_sizes[num_page_sizes++] = recorded_page_size * 4;
+        page_sizes[num_page_sizes++] = recorded_page_size * 16;
+    }
+    // default to fully associative, 64 sets and the current direct mapped geometry
+    if(num_set_counts == 0) {
+        set_counts[num_set_counts++] = 1;
+        set_counts[num_set_counts++] = 64;
+        set_counts[num_set_counts++] = TLB_ENTRIES;
+    }
+
+    struct replay_config configs[MAX_PAGE_SIZES * MAX_SET_COUNTS];
+    int num_configs = 0;
+    for(int p = 0; p < num_page_sizes; p++) {
+        unsigned long page_size = page_sizes[p];
+        if(page_size == 0 || (page_size & (page_size - 1)) != 0) {
+            fprintf(stderr, "page size %lu is not a power of two\n", page_size);
+            fclose(trace);
+            return 1;
+        }
+        int page_bits = 0;
+        while((page_size >> page_bits) != 1) page_bits++;
+
+        for(int s = 0; s < num_set_counts; s++) {
+            unsigned long num_sets = set_counts[s];
+            if(num_sets == 0 || num_sets > max_entries) {
+                fprintf(stderr, "skipping %lu sets, max entries is %lu\n", num_sets, max_entries);
+                continue;
+            }
+            struct replay_config *config = &configs[num_configs++];
+            config->page_size = page_size;
+            config->page_bits = page_bits;
+            config->num_sets = num_sets;
+            config->max_ways = max_entries / num_sets;
+            config->lru = malloc(num_sets * config->max_ways * sizeof(unsigned long));
+            config->fill = calloc(num_sets, sizeof(unsigned long));
+            config->hits = calloc(config->max_ways, sizeof(unsigned long));
+        }
+    }
+
+    // single pass over the trace, feeding every configuration
+    unsigned long accesses = 0;
+    unsigned long va = 0;
+    unsigned long zigzag;
+    while(read_varint(trace, &zigzag) == 0) {
+        long delta = (long) (zigzag >> 1) ^ -(long) (zigzag & 1);
+        va += (unsigned long) delta;
+        for(int c = 0; c < num_configs; c++) {
+            replay_access(&configs[c], va >> configs[c].page_bits);
+        }
+        accesses++;
+    }
+    fclose(trace);
+
+    printf("%lu accesses, recorded page size %lu\n\n", accesses, recorded_page_size);
+    for(int c = 0; c < num_configs; c++) {
+        print_config(&configs[c], accesses);
+        free(configs[c].lru);
+        free(configs[c].fill);
+        free(configs[c].hits);
+    }
+
+    return 0;
+}